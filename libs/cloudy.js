@@ -1,22 +1,28 @@
 var ZKClient = require('./zkClient');
-var async = require('async');
+var selector = require('./selector');
 
+// options.selector picks the load-balancing mode: 'weighted' (default),
+// 'least-loaded' or 'hash'; options.replicas sets the virtual nodes per unit
+// of weight on the hash ring; options.registration = 'binary' registers with
+// the binary record (see ZKClient.encode) instead of 'host|port|weight' text
 function Cloudy(options, onCreate, onDelete, onReady) {
     this.onCreate = onCreate;
     this.onReady = onReady;
     this.onDelete = onDelete;
     this.ready = false;
-    this.cur = 0;
+    this.selector = selector.create(options.selector, {replicas: options.replicas});
     var cloudy = this;
-    this.zk = new ZKClient(options, onCreate, function(client) {
-        var idx = cloudy.clients.indexOf(client);
-        if (idx > -1) {
-            cloudy.clients.splice(idx, 1);
-        }
+    // the selector follows every change itself, so only the diff is needed
+    var zkOptions = Object.assign({}, options, {updates: 'diff'});
+    this.zk = new ZKClient(zkOptions, function(node) {
+        var client = cloudy.onCreate(node);
+        cloudy.selector.add(node.hash, client, node.weight);
+        return client;
+    }, function(client, name) {
+        cloudy.selector.remove(name);
         cloudy.onDelete(client);
-    }, function(err, clients) {
-        cloudy.clients = clients;
-        cloudy.size = cloudy.clients.length;
+    }, function(err, added, removed) {
+        cloudy.size = cloudy.selector.size;
         if (!cloudy.ready) {
             cloudy.ready = true;
             cloudy.onReady();
@@ -24,14 +30,30 @@ function Cloudy(options, onCreate, onDelete, onReady) {
     });
 }
 
-Cloudy.prototype.register = function(host, port, weight) {
+// info optionally describes the endpoint to consumers: {zone, capacity, meta}
+Cloudy.prototype.register = function(host, port, weight, info) {
     var cloudy = this;
     weight = weight || 1;
-    this.zk.add(host, port, weight);
+    this.zk.add(host, port, weight, info);
+    this.unregisterOnExit(function() {
+        cloudy.unregister(host, port);
+    });
+}
+
+// register several endpoints of this process in one atomic request
+Cloudy.prototype.registerAll = function(endpoints) {
+    var cloudy = this;
+    this.zk.addAll(endpoints);
+    this.unregisterOnExit(function() {
+        cloudy.unregisterAll(endpoints);
+    });
+}
+
+Cloudy.prototype.unregisterOnExit = function(cleanup) {
     function exitHandler(options, err) {
         if (options.cleanup) {
             console.log('Unregister Service Server From Cloudy');
-            cloudy.unregister(host, port);
+            cleanup();
         }
         if (err) {
             console.log('Process Error:', err.stack);
@@ -52,12 +74,26 @@ Cloudy.prototype.unregister = function(host, port) {
     this.zk.delete(host, port);
 }
 
-Cloudy.prototype.client = function() {
-    if (!this.size) {
-        return null;
+Cloudy.prototype.unregisterAll = function(endpoints) {
+    this.zk.deleteAll(endpoints);
+}
+
+// every registered client, as the array the round-robin Cloudy kept
+Object.defineProperty(Cloudy.prototype, 'clients', {
+    get: function() {
+        return this.zk.clients();
     }
-    this.cur = (this.cur + 1) % this.size;
-    return this.clients[this.cur];
+});
+
+// key is only used by the hash selector: the same key maps to the same client
+// for as long as that client stays registered
+Cloudy.prototype.client = function(key) {
+    return this.selector.pick(key);
+}
+
+// tells the least-loaded selector that a request to client has finished
+Cloudy.prototype.release = function(client) {
+    this.selector.release(client);
 }
 
 module.exports = Cloudy;
@@ -0,0 +1,226 @@
+var RBTree = require('bintrees').RBTree;
+
+// Selectors pick one registered client per call. Every selector keeps its own
+// index, updated one node at a time from the create/delete events, so neither a
+// pick nor a membership change walks the whole node list:
+//
+//   weighted     smooth weighted round-robin, O(log n) pick
+//   least-loaded power-of-two-choices on in-flight requests, O(1) pick
+//   hash         consistent-hash ring with virtual nodes, O(log n) pick by key
+//
+// add(name, client, weight), remove(name), pick(key) and release(client) are
+// shared by all three; release only matters to least-loaded.
+
+// 32-bit FNV-1a with a murmur3 finalizer, so that nearby keys spread over the ring
+function hash32(str) {
+    var h = 0x811c9dc5;
+    for (var i = 0; i < str.length; i++) {
+        h ^= str.charCodeAt(i);
+        h = Math.imul(h, 0x01000193);
+    }
+    h ^= h >>> 16;
+    h = Math.imul(h, 0x85ebca6b);
+    h ^= h >>> 13;
+    h = Math.imul(h, 0xc2b2ae35);
+    h ^= h >>> 16;
+    return h >>> 0;
+}
+
+function normalizeWeight(weight) {
+    weight = parseFloat(weight);
+    return weight > 0 ? weight : 1;
+}
+
+// Stride scheduling: each node advances its pass by 1/weight when picked and the
+// node with the lowest pass goes next. Like nginx's smooth weighted round-robin
+// this spreads a heavy node's picks between the others, but the nodes are kept
+// ordered in a tree instead of scanned on every pick. A node that joins starts
+// half a stride past the current pass, so it neither gets a burst of picks to
+// catch up nor lines up with every other newcomer.
+function WeightedSelector() {
+    this.tree = new RBTree(function(a, b) {
+        return a.pass - b.pass || a.seq - b.seq;
+    });
+    this.nodes = {};
+    this.seq = 0;
+    this.size = 0;
+}
+
+WeightedSelector.prototype.add = function(name, client, weight) {
+    this.remove(name);
+    var min = this.tree.min();
+    var stride = 1 / normalizeWeight(weight);
+    var node = {
+        client: client,
+        stride: stride,
+        pass: (min ? min.pass : 0) + stride / 2,
+        seq: this.seq++
+    };
+    this.nodes[name] = node;
+    this.tree.insert(node);
+    this.size++;
+}
+
+WeightedSelector.prototype.remove = function(name) {
+    var node = this.nodes[name];
+    if (!node) {
+        return;
+    }
+    this.tree.remove(node);
+    delete this.nodes[name];
+    this.size--;
+}
+
+WeightedSelector.prototype.pick = function() {
+    var node = this.tree.min();
+    if (!node) {
+        return null;
+    }
+    this.tree.remove(node);
+    node.pass += node.stride;
+    // sequence numbers break ties in round-robin order
+    node.seq = this.seq++;
+    this.tree.insert(node);
+    return node.client;
+}
+
+WeightedSelector.prototype.release = function(client) {
+}
+
+// Power of two choices: sample two nodes at random and take the one with fewer
+// requests in flight per unit of weight. Callers report completion through
+// release(client). Nodes live in an array with swap-remove, so both picks and
+// membership changes are O(1).
+function LeastLoadedSelector() {
+    this.list = [];
+    this.nodes = {};
+    this.clients = new Map();
+    this.size = 0;
+}
+
+LeastLoadedSelector.prototype.add = function(name, client, weight) {
+    this.remove(name);
+    var node = {
+        name: name,
+        client: client,
+        weight: normalizeWeight(weight),
+        inflight: 0,
+        index: this.list.length
+    };
+    this.list.push(node);
+    this.nodes[name] = node;
+    this.clients.set(client, node);
+    this.size++;
+}
+
+LeastLoadedSelector.prototype.remove = function(name) {
+    var node = this.nodes[name];
+    if (!node) {
+        return;
+    }
+    var last = this.list.pop();
+    if (last !== node) {
+        last.index = node.index;
+        this.list[node.index] = last;
+    }
+    delete this.nodes[name];
+    this.clients.delete(node.client);
+    this.size--;
+}
+
+LeastLoadedSelector.prototype.pick = function() {
+    var n = this.list.length;
+    if (n === 0) {
+        return null;
+    }
+    var node = this.list[Math.floor(Math.random() * n)];
+    if (n > 1) {
+        // the second sample is drawn from the other n - 1 nodes
+        var i = Math.floor(Math.random() * (n - 1));
+        var other = this.list[i >= node.index ? i + 1 : i];
+        if (other.inflight / other.weight < node.inflight / node.weight) {
+            node = other;
+        }
+    }
+    node.inflight++;
+    return node.client;
+}
+
+LeastLoadedSelector.prototype.release = function(client) {
+    var node = this.clients.get(client);
+    if (node && node.inflight > 0) {
+        node.inflight--;
+    }
+}
+
+// Consistent hashing: each node owns replicas * weight points on a 32-bit ring
+// and a key goes to the first point at or after its hash. When a node leaves
+// only the keys on its points move.
+function HashRingSelector(options) {
+    options = options || {};
+    this.replicas = options.replicas || 160;
+    this.ring = new RBTree(function(a, b) {
+        return a.point - b.point || (a.name < b.name ? -1 : a.name > b.name ? 1 : 0);
+    });
+    this.nodes = {};
+    this.size = 0;
+}
+
+HashRingSelector.prototype.add = function(name, client, weight) {
+    this.remove(name);
+    var count = Math.max(1, Math.round(this.replicas * normalizeWeight(weight)));
+    var points = new Array(count);
+    for (var i = 0; i < count; i++) {
+        points[i] = {point: hash32(name + '#' + i), name: name, client: client};
+        this.ring.insert(points[i]);
+    }
+    this.nodes[name] = points;
+    this.size++;
+}
+
+HashRingSelector.prototype.remove = function(name) {
+    var points = this.nodes[name];
+    if (!points) {
+        return;
+    }
+    for (var i = 0; i < points.length; i++) {
+        this.ring.remove(points[i]);
+    }
+    delete this.nodes[name];
+    this.size--;
+}
+
+// picks by key; without one a random point of the ring is used
+HashRingSelector.prototype.pick = function(key) {
+    if (this.size === 0) {
+        return null;
+    }
+    var point = key === undefined || key === null ?
+        Math.floor(Math.random() * 0x100000000) : hash32(String(key));
+    // '' sorts before every name, so this lands on the first point >= the hash
+    var found = this.ring.lowerBound({point: point, name: ''}).data() || this.ring.min();
+    return found.client;
+}
+
+HashRingSelector.prototype.release = function(client) {
+}
+
+var modes = {
+    'weighted': WeightedSelector,
+    'least-loaded': LeastLoadedSelector,
+    'hash': HashRingSelector
+};
+
+function create(mode, options) {
+    var Selector = modes[mode || 'weighted'];
+    if (!Selector) {
+        throw new Error('Unknown selector: ' + mode);
+    }
+    return new Selector(options);
+}
+
+exports.create = create;
+exports.hash32 = hash32;
+exports.WeightedSelector = WeightedSelector;
+exports.LeastLoadedSelector = LeastLoadedSelector;
+exports.HashRingSelector = HashRingSelector;
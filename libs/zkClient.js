@@ -1,8 +1,10 @@
 var ZooKeeper = require('zookeeper');
 var utils = require('utility');
-var async = require('async');
 var path = require('path');
 
+// onUpdated(err, clients) gets every current client after each change; with
+// options.updates = 'diff' it gets onUpdated(err, addedClients, removedClients)
+// instead, which costs work in proportion to the change rather than the cluster
 function ZKClient(options, onCreate, onDelete, onUpdated) {
     options.host = options.host || 'localhost';
     options.port = options.port || '2181';
@@ -20,6 +22,7 @@ function ZKClient(options, onCreate, onDelete, onUpdated) {
     this.onDelete = onDelete;
     this.onUpdated = onUpdated;
     this.nodes = {};
+    this.size = 0;
 
     var zk = this;
     new Promise(function(resolve, reject) {
@@ -52,7 +55,7 @@ function ZKClient(options, onCreate, onDelete, onUpdated) {
                 }
             });
         }).then(function(reply) {
-             zk.getAll(onUpdated);
+             zk.watch(onUpdated);
         }).catch(function(err) {
             return console.error(err);
         });
@@ -61,7 +64,8 @@ function ZKClient(options, onCreate, onDelete, onUpdated) {
 
 };
 
-ZKClient.prototype.add = function(host, port, weight) {
+// info carries optional metadata for the registration: {zone, capacity, meta}
+ZKClient.prototype.add = function(host, port, weight, info) {
     var zk = this;
     weight = weight || 1;
     var url = host + ':' + port;
@@ -69,7 +73,7 @@ ZKClient.prototype.add = function(host, port, weight) {
     new Promise(function(resolve, reject){
         zk.client.a_create(
             zk.options.path + '/' + name, 
-            new Buffer([host, port, weight].join('|')),
+            zk.encode(host, port, weight, info),
             ZooKeeper.ZOO_EPHEMERAL, 
             function(rc, error, path){
                 if(rc) {
@@ -110,11 +114,64 @@ ZKClient.prototype.delete = function(host, port) {
     });
 }
 
-ZKClient.prototype.getAll = function(cb) {
+// register many endpoints atomically in one request:
+// [{host, port, weight, zone, capacity, meta}, ...]
+ZKClient.prototype.addAll = function(endpoints) {
     var zk = this;
+    var ops = endpoints.map(function(endpoint) {
+        var weight = endpoint.weight || 1;
+        return {
+            type: ZooKeeper.ZOO_CREATE_OP,
+            path: zk.options.path + '/' + utils.md5(endpoint.host + ':' + endpoint.port),
+            data: zk.encode(endpoint.host, endpoint.port, weight, endpoint),
+            flags: ZooKeeper.ZOO_EPHEMERAL
+        };
+    });
+    return zk.multi(ops);
+}
+
+// drain many endpoints atomically in one request: [{host, port}, ...]
+ZKClient.prototype.deleteAll = function(endpoints) {
+    var zk = this;
+    var ops = endpoints.map(function(endpoint) {
+        return {
+            type: ZooKeeper.ZOO_DELETE_OP,
+            path: zk.options.path + '/' + utils.md5(endpoint.host + ':' + endpoint.port),
+            version: 0
+        };
+    });
+    return zk.multi(ops);
+}
+
+ZKClient.prototype.multi = function(ops) {
+    var zk = this;
+    return new Promise(function(resolve, reject){
+        zk.client.a_multi(ops, function(rc, error, results){
+            if(rc) {
+                var err = new Error(error);
+                err.code = rc;
+                err.results = results;
+                reject(err);
+            } else {
+                resolve(results);
+            }
+        })
+    }).catch(function(err) {
+        if (err) {
+            console.error(err);
+        }
+    });
+}
+
+// Follows the children of options.path. The binding keeps the previous listing
+// in this client's own view and reports only the children added (with their
+// data) and removed since. cb runs once per change, see onUpdated above.
+ZKClient.prototype.watch = function(cb) {
+    var zk = this;
+    zk.view = zk.view || zk.client.children_view(zk.options.path);
     new Promise(function(resolve, reject){
         var watcher = new Promise(function(w_resolve, w_reject){
-            zk.client.aw_get_children(zk.options.path, function watch_cb(type, state, path){
+            zk.client.a_get_children_diff(zk.view, function watch_cb(type, state, path){
                 var types = 'child,create,datachanged,deleted,none'.split(',')
                 var event = {
                     type: types[type],
@@ -122,7 +179,7 @@ ZKClient.prototype.getAll = function(cb) {
                     path: path
                 };
                 w_resolve(event);
-            },  function child_cb(rc, error, children){
+            },  function diff_cb(rc, error, added, removed){
                 if(rc) {
                     var err = new Error(error);
                     err.code = rc;
@@ -130,87 +187,110 @@ ZKClient.prototype.getAll = function(cb) {
                 } else {
                     resolve({
                         watch: watcher,
-                        children: children
+                        added: added,
+                        removed: removed
                     });
                 }
             })
         });
-        
-        
     }).then(function(reply) {
         reply.watch.then(function(event) {
-            zk.getAll(cb)
+            zk.watch(cb)
         });
-        var children = reply.children;
-        if (children && children.length > 0) {
-            async.map(children, function(child, cbk) {
-                if (child in zk.nodes) {
-                    cbk(null, zk.nodes[child]);
-                } else {
-                    zk.get(child, cbk);
-                }
-            }, function(err, clients){
-                cb(err, clients);
-            });
+        var removed = [];
+        for (var i = 0; i < reply.removed.length; i++) {
+            var name = reply.removed[i];
+            // a child deleted before its data was read is removed without having been added
+            if (!(name in zk.nodes)) {
+                continue;
+            }
+            var client = zk.nodes[name];
+            delete zk.nodes[name];
+            zk.size--;
+            removed.push(client);
+            zk.onDelete(client, name);
+        }
+        var added = [];
+        for (var child in reply.added) {
+            var node = zk.parse(child, reply.added[child].data, reply.added[child].registration);
+            if (!node) {
+                console.error('Data error: ' + zk.options.path + '/' + child);
+                continue;
+            }
+            zk.nodes[child] = zk.onCreate(node);
+            zk.size++;
+            added.push(zk.nodes[child]);
+        }
+        var err = zk.size > 0 ? null : 'No nodes available!';
+        if (zk.options.updates == 'diff') {
+            cb(err, added, removed);
         } else {
-            cb('No nodes available!', []);
+            cb(err, zk.clients());
+        }
+    }).catch(function(err) {
+        console.error(err);
+        // no watch is armed after a failed listing, try again once connected
+        if (err.code) {
+            setTimeout(function() {
+                zk.watch(cb);
+            }, 1000);
         }
     });
 }
 
-ZKClient.prototype.get = function(name, cb) {
-    var path = this.options.path + '/' + name;
-    var zk = this;
-    new Promise(function(resolve, reject){
-        var watcher = new Promise(function(w_resolve, w_reject){
-            zk.client.aw_get(path, function watch_cb(type, state, path){
-                var types = 'none,created,deleted,datachanged,childchanged'.split(',');
-                var event = {
-                    type: types[type],
-                    state: state,
-                    path: path
-                };
-                w_resolve(event);
+// options.registration = 'binary' publishes the binary record, which carries
+// zone, capacity and meta; the default stays the 'host|port|weight' text that
+// older readers understand. Switch writers over once every reader parses both.
+ZKClient.prototype.encode = function(host, port, weight, info) {
+    info = info || {};
+    if (this.options.registration != 'binary') {
+        return new Buffer([host, port, weight].join('|'));
+    }
+    return ZooKeeper.encode_registration({
+        host: host,
+        port: port,
+        weight: weight,
+        zone: info.zone,
+        capacity: info.capacity,
+        meta: info.meta
+    });
+}
 
-            },  function data_cb(rc, error, stat, data){
-                if(rc) {
-                    var err = new Error(error);
-                    err.code = rc;
-                    reject(err);
-                } else {
-                    resolve({
-                        watch: watcher,
-                        data: data
-                    });
-                }
-            })
-        })
-        
-       
-    }).then(function(reply) {
-        reply.watch.then(function(event) {
-            if (event.type == 'deleted') {
-                zk.onDelete(zk.nodes[name]);
-                delete zk.nodes[name];
-            }
-        });
-        var arr = reply.data.toString().split('|');
-        if (arr.length < 3) {
-            return cb('Data error: ' + path);
-        }
-        var node = {
-            host: arr[0],
-            port: parseInt(arr[1]),
-            weight: parseFloat(arr[2]),
+// registration is the record already decoded by the binding, if any; data may
+// also hold a record or the 'host|port|weight' text of older registrations
+ZKClient.prototype.parse = function(name, data, registration) {
+    if (!registration && Buffer.isBuffer(data)) {
+        registration = ZooKeeper.decode_registration(data);
+    }
+    if (registration) {
+        return {
+            host: registration.host,
+            port: registration.port,
+            weight: registration.weight,
+            zone: registration.zone,
+            capacity: registration.capacity,
+            meta: registration.meta,
             hash: name
-        };      
-        zk.nodes[name] = zk.onCreate(node);
-        cb(null, zk.nodes[name]);
-    }, function(err, data, stats) {
-        if (err || !data || data.length === 0) {
-            return cb(err);
-        }
-    })
+        };
+    }
+    var arr = data ? data.toString().split('|') : [];
+    if (arr.length < 3) {
+        return null;
+    }
+    return {
+        host: arr[0],
+        port: parseInt(arr[1]),
+        weight: parseFloat(arr[2]),
+        hash: name
+    };
+}
+
+// every client currently known, in no particular order
+ZKClient.prototype.clients = function() {
+    var zk = this;
+    return Object.keys(zk.nodes).map(function(name) {
+        return zk.nodes[name];
+    });
 }
 
 module.exports = ZKClient;
@@ -0,0 +1,83 @@
+// Selector benchmark: picks/sec for every mode, how closely the weighted mode
+// follows the weights, and how many keys the hash ring remaps when one node
+// leaves (the ideal is the departed node's share, 1/N with equal weights).
+//
+//   node samples/bench_selector.js [nodes] [picks] [keys]
+
+var selector = require('../libs/selector');
+
+var N = parseInt(process.argv[2] || 32);
+var PICKS = parseInt(process.argv[3] || 2000000);
+var KEYS = parseInt(process.argv[4] || 200000);
+
+function build(mode, weight) {
+    var s = selector.create(mode);
+    for (var i = 0; i < N; i++) {
+        var name = '10.0.0.' + i + ':8080';
+        s.add(name, {name: name, weight: weight(i)}, weight(i));
+    }
+    return s;
+}
+
+function equal() {
+    return 1;
+}
+
+function bench(mode) {
+    var s = build(mode, equal);
+    var started = process.hrtime();
+    for (var i = 0; i < PICKS; i++) {
+        var client = s.pick(mode == 'hash' ? 'key' + i : undefined);
+        s.release(client);
+    }
+    var elapsed = process.hrtime(started);
+    var secs = elapsed[0] + elapsed[1] / 1e9;
+    console.log('%s: %d picks over %d nodes in %s s, %d picks/sec',
+                mode, PICKS, N, secs.toFixed(3), Math.round(PICKS / secs));
+}
+
+function distribution() {
+    var s = build('weighted', function(i) { return i % 4 + 1; });
+    var counts = {};
+    var total = 0;
+    var picks = N * 100;
+    for (var i = 0; i < picks; i++) {
+        var client = s.pick();
+        counts[client.name] = (counts[client.name] || 0) + 1;
+    }
+    for (var i = 0; i < N; i++) {
+        total += i % 4 + 1;
+    }
+    var worst = 0;
+    for (var i = 0; i < N; i++) {
+        var expected = picks * (i % 4 + 1) / total;
+        var got = counts['10.0.0.' + i + ':8080'] || 0;
+        worst = Math.max(worst, Math.abs(got - expected) / expected);
+    }
+    console.log('weighted: %d picks, worst deviation from weight share %s%%',
+                picks, (worst * 100).toFixed(2));
+}
+
+function churn() {
+    var s = build('hash', equal);
+    var before = new Array(KEYS);
+    for (var i = 0; i < KEYS; i++) {
+        before[i] = s.pick('key' + i).name;
+    }
+    var gone = '10.0.0.0:8080';
+    s.remove(gone);
+    var moved = 0, lost = 0;
+    for (var i = 0; i < KEYS; i++) {
+        var now = s.pick('key' + i).name;
+        if (now != before[i]) {
+            moved++;
+            if (before[i] != gone) lost++;
+        }
+    }
+    console.log('hash: %d keys, %s%% remapped after one of %d nodes left (ideal %s%%), %d moved between surviving nodes',
+                KEYS, (moved / KEYS * 100).toFixed(2), N, (100 / N).toFixed(2), lost);
+}
+
+['weighted', 'least-loaded', 'hash'].forEach(bench);
+distribution();
+churn();